@@ -23,4 +23,7 @@ typedef struct {
     size_t cap;
 } AsteroidDB;
 
+int parse_csv_line(char *line, Asteroid *out);
+void normalize_name(const char *name, char *out, size_t outsz);
+
 #endif
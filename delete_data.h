@@ -2,7 +2,9 @@
 #define DELETE_DATA_H
 
 #include "asteroid_db.h"
+#include "name_index.h"
 
-void delete_data(AsteroidDB *db, const char *csv_path);
+/* returns 1 when a row was removed from db, 0 when nothing changed */
+int delete_data(AsteroidDB *db, NameIndex *names, const char *csv_path);
 
 #endif
@@ -37,7 +37,16 @@ static int local_read_int(const char *prompt) {
 }
 
 
-void edit_data(AsteroidDB *db) {
+static Asteroid *find_by_name(AsteroidDB *db, const char *name) {
+    size_t i;
+    for (i = 0; i < db->size; i++) {
+        if (strcmp(db->data[i].name, name) == 0) return &db->data[i];
+    }
+    return NULL;
+}
+
+
+int edit_data(AsteroidDB *db, const NameIndex *names) {
     printf("\n=========================================\n");
     printf("     EDIT MODE: UPDATE ASTEROID DATA     \n");
     printf("=========================================\n");
@@ -45,19 +54,17 @@ void edit_data(AsteroidDB *db) {
     char targetName[STR_MAX];
     local_read_string("Enter the name of the asteroid to edit: ", targetName, sizeof(targetName));
 
-    Asteroid *found = NULL;
-    int i;
-    for (i = 0; i < db->size; i++) {
-        if (strcmp(db->data[i].name, targetName) == 0) {
-            found = &db->data[i]; //
-            break;
-        }
+    Asteroid *found = find_by_name(db, targetName);
+
+    // typo? offer the closest names
+    if (found == NULL && name_index_pick(names, targetName, targetName, sizeof(targetName))) {
+        found = find_by_name(db, targetName);
     }
 
     if (found == NULL) {
         printf("\n[ERROR] Asteroid '%s' not found in database.\n", targetName);
         printf("Returning to menu...\n");
-        return; 
+        return 0;
     }
 
     printf("\n--- Current Data for '%s' ---\n", found->name);
@@ -84,4 +91,5 @@ void edit_data(AsteroidDB *db) {
     printf("Updated: [%s] %s (Vel: %.2f km/s)\n", found->date, found->name, found->velocity_km_s);
     printf("Press Enter to return to menu...");
     getchar();
+    return 1;
 }
@@ -2,7 +2,9 @@
 #define EDIT_DATA_H
 
 #include "asteroid_db.h"
+#include "name_index.h"
 
-void edit_data(AsteroidDB *db);
+/* returns 1 when a row was updated, 0 when nothing changed */
+int edit_data(AsteroidDB *db, const NameIndex *names);
 
 #endif
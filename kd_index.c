@@ -0,0 +1,333 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <pthread.h>
+#endif
+
+#include "kd_index.h"
+
+/* ---------- features ---------- */
+static double raw_value(const Asteroid *a, int dim) {
+    switch (dim) {
+        case KD_DIAMETER: return (a->diameter_min_m + a->diameter_max_m) / 2.0;
+        case KD_VELOCITY: return a->velocity_km_s;
+        case KD_MISS:     return a->miss_distance_km;
+        default:          return a->absolute_magnitude_h;
+    }
+}
+
+static double feature(int dim, double v) {
+    // sizes and distances span orders of magnitude
+    if (dim == KD_DIAMETER) return log10(v > 1e-3 ? v : 1e-3);
+    if (dim == KD_MISS) return log10(v > 1.0 ? v : 1.0);
+    return v;
+}
+
+static void make_point(const KdIndex *ki, const Asteroid *a, double p[KD_DIMS]) {
+    for (int d = 0; d < KD_DIMS; d++) {
+        p[d] = (feature(d, raw_value(a, d)) - ki->mean[d]) / ki->scale[d];
+    }
+}
+
+/* ---------- bulk build ---------- */
+static void swap_nodes(KdNode *a, KdNode *b) {
+    KdNode t = *a;
+    *a = *b;
+    *b = t;
+}
+
+/* quickselect: puts the nth point (by axis) at nodes[nth], smaller before, larger after */
+static void select_nth(KdNode *nodes, size_t lo, size_t hi, size_t nth, int axis) {
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        // median of three as pivot, parked at hi-1
+        if (nodes[mid].p[axis] < nodes[lo].p[axis]) swap_nodes(&nodes[mid], &nodes[lo]);
+        if (nodes[hi-1].p[axis] < nodes[lo].p[axis]) swap_nodes(&nodes[hi-1], &nodes[lo]);
+        if (nodes[mid].p[axis] < nodes[hi-1].p[axis]) swap_nodes(&nodes[mid], &nodes[hi-1]);
+        double pivot = nodes[hi-1].p[axis];
+
+        size_t store = lo;
+        for (size_t i = lo; i + 1 < hi; i++) {
+            if (nodes[i].p[axis] < pivot) swap_nodes(&nodes[i], &nodes[store++]);
+        }
+        swap_nodes(&nodes[store], &nodes[hi-1]);
+
+        if (nth == store) return;
+        if (nth < store) hi = store;
+        else lo = store + 1;
+    }
+}
+
+typedef struct {
+    KdNode *nodes;
+    size_t lo;
+    size_t hi;
+    int depth;
+    int result;
+} KdTask;
+
+static int build_range(KdNode *nodes, size_t lo, size_t hi, int depth);
+
+#ifdef _WIN32
+static DWORD WINAPI build_task(LPVOID arg) {
+    KdTask *t = (KdTask*)arg;
+    t->result = build_range(t->nodes, t->lo, t->hi, t->depth);
+    return 0;
+}
+#else
+static void *build_task(void *arg) {
+    KdTask *t = (KdTask*)arg;
+    t->result = build_range(t->nodes, t->lo, t->hi, t->depth);
+    return NULL;
+}
+#endif
+
+static int build_range(KdNode *nodes, size_t lo, size_t hi, int depth) {
+    if (lo >= hi) return -1;
+
+    int axis = depth % KD_DIMS;
+    size_t mid = lo + (hi - lo) / 2;
+    select_nth(nodes, lo, hi, mid, axis);
+    nodes[mid].axis = axis;
+
+    // both halves are disjoint ranges of the array: the left one can go to another thread
+    if (depth < KD_PAR_DEPTH && hi - lo >= KD_PAR_MIN) {
+        KdTask t = { nodes, lo, mid, depth + 1, -1 };
+#ifdef _WIN32
+        HANDLE th = CreateThread(NULL, 0, build_task, &t, 0, NULL);
+        if (th) {
+            nodes[mid].right = build_range(nodes, mid + 1, hi, depth + 1);
+            WaitForSingleObject(th, INFINITE);
+            CloseHandle(th);
+            nodes[mid].left = t.result;
+            return (int)mid;
+        }
+#else
+        pthread_t th;
+        if (pthread_create(&th, NULL, build_task, &t) == 0) {
+            nodes[mid].right = build_range(nodes, mid + 1, hi, depth + 1);
+            pthread_join(th, NULL);
+            nodes[mid].left = t.result;
+            return (int)mid;
+        }
+#endif
+    }
+
+    nodes[mid].left = build_range(nodes, lo, mid, depth + 1);
+    nodes[mid].right = build_range(nodes, mid + 1, hi, depth + 1);
+    return (int)mid;
+}
+
+/* ---------- public ---------- */
+void kd_index_init(KdIndex *ki) {
+    ki->nodes = NULL;
+    ki->size = 0;
+    ki->cap = 0;
+    ki->root = -1;
+    for (int d = 0; d < KD_DIMS; d++) {
+        ki->mean[d] = 0.0;
+        ki->scale[d] = 1.0;
+    }
+}
+
+void kd_index_free(KdIndex *ki) {
+    free(ki->nodes);
+    kd_index_init(ki);
+}
+
+int kd_index_build(KdIndex *ki, const AsteroidDB *db) {
+    size_t n = db->size;
+    ki->size = 0;
+    ki->root = -1;
+
+    if (n > ki->cap) {
+        KdNode *p = (KdNode*)realloc(ki->nodes, n * sizeof(KdNode));
+        if (!p) return 0;
+        ki->nodes = p;
+        ki->cap = n;
+    }
+
+    // scale of each dimension (kept for later inserts)
+    for (int d = 0; d < KD_DIMS; d++) {
+        double sum = 0.0, sq = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            double f = feature(d, raw_value(&db->data[i], d));
+            sum += f;
+            sq += f * f;
+        }
+        double mean = (n > 0) ? sum / (double)n : 0.0;
+        double var = (n > 0) ? sq / (double)n - mean * mean : 0.0;
+        ki->mean[d] = mean;
+        ki->scale[d] = (var > 1e-12) ? sqrt(var) : 1.0;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        make_point(ki, &db->data[i], ki->nodes[i].p);
+        ki->nodes[i].row = i;
+    }
+    ki->size = n;
+    ki->root = build_range(ki->nodes, 0, n, 0);
+    return 1;
+}
+
+int kd_index_insert(KdIndex *ki, const AsteroidDB *db, size_t row) {
+    if (row >= db->size) return 0;
+
+    if (ki->size == ki->cap) {
+        size_t next = (ki->cap == 0) ? 64 : ki->cap * 2;
+        KdNode *p = (KdNode*)realloc(ki->nodes, next * sizeof(KdNode));
+        if (!p) return 0;
+        ki->nodes = p;
+        ki->cap = next;
+    }
+
+    int added = (int)ki->size++;
+    KdNode *n = &ki->nodes[added];
+    make_point(ki, &db->data[row], n->p);
+    n->row = row;
+    n->left = -1;
+    n->right = -1;
+    n->axis = 0;
+
+    if (ki->root < 0) {
+        ki->root = added;
+        return 1;
+    }
+
+    int cur = ki->root;
+    for (;;) {
+        KdNode *c = &ki->nodes[cur];
+        int *next = (n->p[c->axis] < c->p[c->axis]) ? &c->left : &c->right;
+        if (*next < 0) {
+            n->axis = (c->axis + 1) % KD_DIMS;
+            *next = added;
+            return 1;
+        }
+        cur = *next;
+    }
+}
+
+/* ---------- queries ---------- */
+typedef struct {
+    const KdIndex *ki;
+    double q[KD_DIMS];
+    size_t k;
+    size_t found;
+    size_t *rows;
+    double *d2;           // squared distances, ascending
+} KdSearch;
+
+static void nearest_rec(KdSearch *s, int idx) {
+    if (idx < 0) return;
+    const KdNode *n = &s->ki->nodes[idx];
+
+    double d2 = 0.0;
+    for (int d = 0; d < KD_DIMS; d++) {
+        double diff = s->q[d] - n->p[d];
+        d2 += diff * diff;
+    }
+
+    // insertion into the sorted result list (drops the worst when full)
+    if (s->found < s->k || d2 < s->d2[s->k - 1]) {
+        size_t pos = (s->found < s->k) ? s->found++ : s->k - 1;
+        while (pos > 0 && s->d2[pos-1] > d2) {
+            s->d2[pos] = s->d2[pos-1];
+            s->rows[pos] = s->rows[pos-1];
+            pos--;
+        }
+        s->d2[pos] = d2;
+        s->rows[pos] = n->row;
+    }
+
+    double diff = s->q[n->axis] - n->p[n->axis];
+    int near = (diff < 0) ? n->left : n->right;
+    int far  = (diff < 0) ? n->right : n->left;
+
+    nearest_rec(s, near);
+    // the other side can only help if the splitting plane is closer than the worst result
+    if (s->found < s->k || diff * diff < s->d2[s->k - 1]) nearest_rec(s, far);
+}
+
+size_t kd_index_nearest(const KdIndex *ki, const Asteroid *a, size_t k, size_t *rows, double *dists) {
+    if (ki->root < 0 || k == 0) return 0;
+
+    KdSearch s;
+    s.ki = ki;
+    make_point(ki, a, s.q);
+    s.k = k;
+    s.found = 0;
+    s.rows = rows;
+    s.d2 = dists;
+
+    nearest_rec(&s, ki->root);
+
+    for (size_t i = 0; i < s.found; i++) dists[i] = sqrt(dists[i]);
+    return s.found;
+}
+
+typedef struct {
+    const KdIndex *ki;
+    double lo[KD_DIMS];
+    double hi[KD_DIMS];
+    size_t *rows;
+    size_t count;
+    size_t cap;
+    int failed;
+} KdBox;
+
+static void box_rec(KdBox *b, int idx) {
+    if (idx < 0 || b->failed) return;
+    const KdNode *n = &b->ki->nodes[idx];
+
+    int inside = 1;
+    for (int d = 0; d < KD_DIMS && inside; d++) {
+        if (n->p[d] < b->lo[d] || n->p[d] > b->hi[d]) inside = 0;
+    }
+    if (inside) {
+        if (b->count == b->cap) {
+            size_t next = (b->cap == 0) ? 64 : b->cap * 2;
+            size_t *p = (size_t*)realloc(b->rows, next * sizeof(size_t));
+            if (!p) {
+                b->failed = 1;
+                return;
+            }
+            b->rows = p;
+            b->cap = next;
+        }
+        b->rows[b->count++] = n->row;
+    }
+
+    // left subtree holds values <= split, right subtree values >= split
+    if (b->lo[n->axis] <= n->p[n->axis]) box_rec(b, n->left);
+    if (b->hi[n->axis] >= n->p[n->axis]) box_rec(b, n->right);
+}
+
+size_t *kd_index_box(const KdIndex *ki, const double lo[KD_DIMS], const double hi[KD_DIMS], size_t *count) {
+    KdBox b;
+    b.ki = ki;
+    b.rows = NULL;
+    b.count = 0;
+    b.cap = 0;
+    b.failed = 0;
+
+    // the transform is monotonic, so the box maps to a box in normalized space
+    for (int d = 0; d < KD_DIMS; d++) {
+        b.lo[d] = (feature(d, lo[d]) - ki->mean[d]) / ki->scale[d];
+        b.hi[d] = (feature(d, hi[d]) - ki->mean[d]) / ki->scale[d];
+    }
+
+    box_rec(&b, ki->root);
+
+    if (b.failed) {
+        free(b.rows);
+        b.rows = NULL;
+        b.count = 0;
+    }
+    *count = b.count;
+    return b.rows;
+}
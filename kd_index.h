@@ -0,0 +1,46 @@
+#ifndef KD_INDEX_H
+#define KD_INDEX_H
+
+#include "asteroid_db.h"
+
+/* k-d tree over (diameter, velocity, miss distance, H) for "similar asteroid"
+   and region queries. Diameter and miss distance are taken in log10, then every
+   field is scaled to zero mean / unit deviation so no unit dominates the distance. */
+
+#define KD_DIMS 4
+#define KD_PAR_DEPTH 2          // build levels split across threads (up to 4 workers)
+#define KD_PAR_MIN 20000        // smaller subtrees are built in the current thread
+
+enum { KD_DIAMETER, KD_VELOCITY, KD_MISS, KD_MAGNITUDE };
+
+typedef struct {
+    double p[KD_DIMS];    // normalized point
+    size_t row;           // position in AsteroidDB.data
+    int axis;
+    int left;             // -1 = none
+    int right;
+} KdNode;
+
+typedef struct {
+    KdNode *nodes;
+    size_t size;
+    size_t cap;
+    int root;
+    double mean[KD_DIMS];
+    double scale[KD_DIMS];
+} KdIndex;
+
+void kd_index_init(KdIndex *ki);
+void kd_index_free(KdIndex *ki);
+
+/* bulk (re)build from the whole db; must be redone when rows move or change */
+int kd_index_build(KdIndex *ki, const AsteroidDB *db);
+int kd_index_insert(KdIndex *ki, const AsteroidDB *db, size_t row);
+
+/* k closest rows to a, closest first. Returns how many were found. */
+size_t kd_index_nearest(const KdIndex *ki, const Asteroid *a, size_t k, size_t *rows, double *dists);
+
+/* rows whose raw values are inside [lo, hi] on every dimension (malloc'd, caller frees) */
+size_t *kd_index_box(const KdIndex *ki, const double lo[KD_DIMS], const double hi[KD_DIMS], size_t *count);
+
+#endif
@@ -5,10 +5,14 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "edit_data.h"
 #include "asteroid_db.h"
 #include "delete_data.h"
+#include "neo_index.h"
+#include "name_index.h"
+#include "kd_index.h"
 
 /* function's prototype*/
 void loadingBar(const char *texto, int passos, int delay_us);
@@ -156,6 +160,21 @@ double read_double(const char *prompt) {
 }
 
 
+/* like read_double, but an empty answer gives `open` (a bound left unset) */
+static double read_bound(const char *prompt, double open) {
+    char buf[256];
+    double x;
+    for (;;) {
+        printf("%s", prompt);
+        if (!fgets(buf, sizeof(buf), stdin)) return open;
+        char *p = buf;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0') return open;
+        if (sscanf(p, "%lf", &x) == 1) return x;
+        printf("Invalid input, hacker. Try again!\n");
+    }
+}
+
 void read_string(const char *prompt, char *out, size_t outsz) {
     printf("%s", prompt);
     if (fgets(out, (int)outsz, stdin)) {
@@ -187,6 +206,23 @@ int split_csv_simple(char *line, char *fields[], int max_fields) {
     return count;
 }
 
+/* lowercase alphanumeric words: "533722 (2014 NE52)" -> "533722 2014 ne52" */
+void normalize_name(const char *name, char *out, size_t outsz) {
+    size_t n = 0;
+    int pending_space = 0;
+    if (outsz == 0) return;
+    for (; name && *name; name++) {
+        unsigned char c = (unsigned char)*name;
+        if (isalnum(c)) {
+            if (pending_space && n > 0 && n + 1 < outsz) out[n++] = ' ';
+            pending_space = 0;
+            if (n + 1 < outsz) out[n++] = (char)tolower(c);
+        } else {
+            pending_space = 1;
+        }
+    }
+    out[n] = '\0';
+}
 
 int parse_csv_line(char *line, Asteroid *out) {
     trim_newline(line);
@@ -261,13 +297,17 @@ void print_header(void) {
     printf("-----------------------------------------------------------------------------------------------\n");
 }
 
-static int append_asteroid_csv(const char *path, const Asteroid *a) {
+static int append_asteroid_csv(const char *path, const Asteroid *a, long *offset) {
     FILE *fp = fopen(path, "a");
     if (!fp) {
         printf("Erro: I could not open '%s' to write (append).\n", path);
         return 0;
     }
 
+    // where the new row starts (used by the NEO index)
+    fseek(fp, 0, SEEK_END);
+    *offset = ftell(fp);
+
     // format: date,name,id,hazardous,absolute_magnitude_h,
     //          diameter_min_m,diameter_max_m,miss_distance_km,velocity_km_s
     fprintf(fp, "%s,%s,%ld,%s,%.10f,%.10f,%.10f,%.10f,%.10f\n",
@@ -302,10 +342,13 @@ void show_menu(void) {
     printf("4) New register\n");
     printf("5) Update\n");
     printf("6) Delete\n");
+    printf("7) Approach history (all dates)\n");
+    printf("8) Similar asteroids\n");
+    printf("9) Search by parameter range\n");
     printf("0) QUIT\n");
 }
 
-void search_by_name(const AsteroidDB *db) {
+void search_by_name(const AsteroidDB *db, const NameIndex *names) {
     char q[STR_MAX];
     read_string("Type part of the name (case-insensitive): ", q, sizeof(q));
     char qlow[STR_MAX];
@@ -313,14 +356,31 @@ void search_by_name(const AsteroidDB *db) {
     tolower_str(qlow);
 
     print_header();
-    size_t i;
+    size_t i, hits = 0;
     for (i = 0; i < db->size; i++) {
         char name_low[STR_MAX];
         strncpy(name_low, db->data[i].name, sizeof(name_low)-1); name_low[sizeof(name_low)-1] = '\0';
         tolower_str(name_low);
 
-        if (strstr(name_low, qlow)) print_one(&db->data[i]);
-        
+        if (strstr(name_low, qlow)) {
+            print_one(&db->data[i]);
+            hits++;
+        }
+    }
+    if (hits > 0) return;
+
+    // nothing contains the text: show the closest names instead (typos)
+    NameMatch m[NAME_FUZZY_K];
+    int n = name_index_nearest(names, q, NAME_FUZZY_MAX_DIST, m, NAME_FUZZY_K);
+    if (n == 0) {
+        printf("No asteroid found for '%s'.\n", q);
+        return;
+    }
+    printf("No exact match. Closest names:\n");
+    for (int k = 0; k < n; k++) {
+        for (i = 0; i < db->size; i++) {
+            if (strcmp(db->data[i].name, m[k].name) == 0) print_one(&db->data[i]);
+        }
     }
 }
 
@@ -359,20 +419,12 @@ static const char* csv_for_key(int key, const RangeMap *maps, int maps_n) {
     return NULL;
 }
 
-static long max_id_in_db(const AsteroidDB *db) {
-    long maxid = 0;
-    for (size_t i = 0; i < db->size; i++) {
-        if (db->data[i].id > maxid) maxid = db->data[i].id;
-    }
-    return maxid;
+static long generate_next_id(const NeoIndex *idx, const char *name) {
+    // ids key the history of every partition, so they must be unique across all of them
+    return neo_index_next_id(idx, name);
 }
 
-static long generate_next_id(const AsteroidDB *db) {
-    long maxid = max_id_in_db(db);
-    return maxid + 1; 
-}
-
-void new_register(AsteroidDB *db, char *g_csv_path, const RangeMap *maps, int maps_n) {
+void new_register(AsteroidDB *db, NeoIndex *idx, NameIndex *names, KdIndex *kd, char *g_csv_path, const RangeMap *maps, int maps_n) {
     basicTransition("REGISTERING NEW NEAR-EARTH OBJECT");
 
     Asteroid a;
@@ -403,7 +455,11 @@ void new_register(AsteroidDB *db, char *g_csv_path, const RangeMap *maps, int ma
 
         strcpy(g_csv_path, target_csv);
         db->size = 0;
-        if (!load_csv(g_csv_path, db)) {
+        int loaded = load_csv(g_csv_path, db);
+        // db was emptied either way: the indexes must follow it, even after a failed load
+        name_index_build(names, db);
+        kd_index_build(kd, db);
+        if (!loaded) {
             printf("[ERROR] Failed to load CSV '%s'. Canceling insert.\n", g_csv_path);
             return;
         }
@@ -423,7 +479,7 @@ void new_register(AsteroidDB *db, char *g_csv_path, const RangeMap *maps, int ma
     a.diameter_max_m       = read_double("Max diameter (m): ");
     a.miss_distance_km     = read_double("Miss distance (km): ");
     a.velocity_km_s        = read_double("Velocity (km/s): ");
-    a.id = generate_next_id(db);
+    a.id = generate_next_id(idx, a.name);
     if (exists_name_date_ci(db, a.name, a.date)) {
         printf("[ERROR] A record with the same NAME and DATE already exists. Insert canceled.\n");
         return;
@@ -435,11 +491,15 @@ void new_register(AsteroidDB *db, char *g_csv_path, const RangeMap *maps, int ma
             printf("Erro: insufficient memory to insert a new register.\n");
             return;
         }
+        name_index_insert(names, a.name);
+        kd_index_insert(kd, db, db->size - 1);
 
-        if (!append_asteroid_csv(g_csv_path, &a)) {
+        long offset;
+        if (!append_asteroid_csv(g_csv_path, &a, &offset)) {
             printf("[WARNING] Saved in memory, but FAILED to update CSV.\n");
         } else {
             printf("[SUCCESS] New asteroid saved in %s\n", g_csv_path);
+            if (neo_index_add_row(idx, g_csv_path, offset, &a)) neo_index_journal_row(idx, NEO_INDEX_FILE);
         }
 
         print_header();
@@ -448,10 +508,137 @@ void new_register(AsteroidDB *db, char *g_csv_path, const RangeMap *maps, int ma
 }
 
 
+/* HISTORY (every partition, read through the NEO index) */
+// startup only: rescans changed partitions and compacts the index file
+static void sync_index(NeoIndex *idx, const RangeMap *maps, int maps_n) {
+    for (int i = 0; i < maps_n; i++) neo_index_sync_partition(idx, maps[i].csv);
+    if (!neo_index_save(idx, NEO_INDEX_FILE)) {
+        printf("[WARNING] Could not save the NEO index (%s).\n", NEO_INDEX_FILE);
+    }
+}
+
+void approach_history(NeoIndex *idx) {
+    char q[STR_MAX];
+    read_string("NEO ID or name: ", q, sizeof(q));
+
+    char *end;
+    long id = strtol(q, &end, 10);
+    if (end == q || *end != '\0') id = 0;   // not a plain number: search by name
+
+    size_t n;
+    int rescanned;
+    Asteroid *rows = neo_index_history(idx, id, q, &n, &rescanned);
+    if (rescanned && !neo_index_save(idx, NEO_INDEX_FILE)) {
+        printf("[WARNING] Could not save the NEO index (%s).\n", NEO_INDEX_FILE);
+    }
+    if (!rows) {
+        printf("[ERROR] No approaches found for '%s'.\n", q);
+        return;
+    }
+
+    print_header();
+    size_t closest = 0;
+    for (size_t i = 0; i < n; i++) {
+        print_one(&rows[i]);
+        if (rows[i].miss_distance_km < rows[closest].miss_distance_km) closest = i;
+    }
+
+    printf("\n%zu approach(es) from %s to %s.\n", n, rows[0].date, rows[n-1].date);
+    printf("Closest: %s at %.0f km (%.2f km/s)\n",
+           rows[closest].date, rows[closest].miss_distance_km, rows[closest].velocity_km_s);
+    if (n > 1) {
+        double trend = rows[n-1].miss_distance_km - rows[0].miss_distance_km;
+        printf("Miss distance trend: %s by %.0f km\n", trend < 0 ? "closer" : "farther",
+               trend < 0 ? -trend : trend);
+    }
+    free(rows);
+}
+
+
+/* SIMILARITY (diameter, velocity, miss distance, H) */
+void similar_asteroids(const AsteroidDB *db, const NameIndex *names, const KdIndex *kd) {
+    char q[STR_MAX];
+    read_string("Asteroid name: ", q, sizeof(q));
+
+    size_t target = db->size;
+    for (size_t i = 0; i < db->size && target == db->size; i++) {
+        if (strcmp(db->data[i].name, q) == 0) target = i;
+    }
+    if (target == db->size && name_index_pick(names, q, q, sizeof(q))) {
+        for (size_t i = 0; i < db->size && target == db->size; i++) {
+            if (strcmp(db->data[i].name, q) == 0) target = i;
+        }
+    }
+    if (target == db->size) {
+        printf("[ERROR] Asteroid '%s' not found.\n", q);
+        return;
+    }
+
+    int k = read_int("How many similar asteroids? ");
+    if (k <= 0) return;
+
+    // one extra: the asteroid itself comes back at distance 0
+    size_t want = (size_t)k + 1;
+    size_t *rows = (size_t*)malloc(want * sizeof(size_t));
+    double *dists = (double*)malloc(want * sizeof(double));
+    if (!rows || !dists) {
+        free(rows);
+        free(dists);
+        printf("Erro: insufficient memory.\n");
+        return;
+    }
+
+    size_t n = kd_index_nearest(kd, &db->data[target], want, rows, dists);
+
+    printf("\nMost similar to %s:\n", db->data[target].name);
+    print_header();
+    size_t shown = 0;
+    for (size_t i = 0; i < n && shown < (size_t)k; i++) {
+        if (rows[i] == target) continue;
+        print_one(&db->data[rows[i]]);
+        shown++;
+    }
+    free(rows);
+    free(dists);
+}
+
+void search_by_range(const AsteroidDB *db, const KdIndex *kd) {
+    double lo[KD_DIMS], hi[KD_DIMS];
+
+    printf("Press Enter to leave a bound open.\n");
+    // the tree holds one diameter per row: the mean of Dmin and Dmax
+    lo[KD_DIAMETER]  = read_bound("Mean diameter, lower bound (m): ", -HUGE_VAL);
+    hi[KD_DIAMETER]  = read_bound("Mean diameter, upper bound (m): ", HUGE_VAL);
+    lo[KD_VELOCITY]  = read_bound("Min velocity (km/s): ", -HUGE_VAL);
+    hi[KD_VELOCITY]  = read_bound("Max velocity (km/s): ", HUGE_VAL);
+    lo[KD_MISS]      = read_bound("Min miss distance (km): ", -HUGE_VAL);
+    hi[KD_MISS]      = read_bound("Max miss distance (km): ", HUGE_VAL);
+    lo[KD_MAGNITUDE] = read_bound("Min absolute magnitude H: ", -HUGE_VAL);
+    hi[KD_MAGNITUDE] = read_bound("Max absolute magnitude H: ", HUGE_VAL);
+
+    size_t n;
+    size_t *rows = kd_index_box(kd, lo, hi, &n);
+
+    print_header();
+    for (size_t i = 0; i < n; i++) print_one(&db->data[rows[i]]);
+    printf("%zu asteroid(s) in range.\n", n);
+    free(rows);
+}
+
+
 int main(void) {
     AsteroidDB db;
     db_init(&db);
 
+    NeoIndex idx;
+    neo_index_init(&idx);
+
+    NameIndex names;
+    name_index_init(&names);
+
+    KdIndex kd;
+    kd_index_init(&kd);
+
     char path_in[256] = "";
     char input[64];
 
@@ -463,6 +650,10 @@ int main(void) {
     };
     const int maps_n = (int)(sizeof(maps) / sizeof(maps[0]));
 
+    // only partitions that changed since the last run are rescanned
+    neo_index_load(&idx, NEO_INDEX_FILE);
+    sync_index(&idx, maps, maps_n);
+
     printf("Type a date to unblock the secret data (YYYY-MM-DD): ");
     if (!fgets(input, sizeof(input), stdin)) {
         printf("Input error.\n");
@@ -505,6 +696,8 @@ int main(void) {
         db_free(&db);
         return 1;
     }
+    name_index_build(&names, &db);
+    kd_index_build(&kd, &db);
 
     loadingBar("Synchronizing db and memory", 20, 35000);
     printf("OK! %zu registers loaded from %s!\n", db.size, path_in);
@@ -560,14 +753,30 @@ int main(void) {
                     db_free(&db);
                     return 1;
                 }
+                name_index_build(&names, &db);
+                kd_index_build(&kd, &db);
 
                 loadingBar("Synchronizing db and memory", 20, 35000);
                 printf("OK! %zu registers loaded from %s!\n", db.size, path_in);
         }
-        else if (op == 3) search_by_name(&db);
-        else if(op == 4) new_register(&db, path_in, maps, maps_n);
-        else if (op == 5) edit_data(&db);
-        else if(op == 6) delete_data(&db, path_in);
+        else if (op == 3) search_by_name(&db, &names);
+        else if(op == 4) new_register(&db, &idx, &names, &kd, path_in, maps, maps_n);
+        else if (op == 5) {
+            // memory only, the CSV rows do not move
+            if (edit_data(&db, &names)) kd_index_build(&kd, &db);
+        }
+        else if(op == 6) {
+            if (delete_data(&db, &names, path_in)) {
+                // every row of the partition was rewritten: rescan it and save the new offsets,
+                // or at least leave a mark so the next start rescans it
+                neo_index_sync_partition(&idx, path_in);
+                if (!neo_index_save(&idx, NEO_INDEX_FILE)) neo_index_journal_dirty(NEO_INDEX_FILE, path_in);
+                kd_index_build(&kd, &db);
+            }
+        }
+        else if (op == 7) approach_history(&idx);
+        else if (op == 8) similar_asteroids(&db, &names, &kd);
+        else if (op == 9) search_by_range(&db, &kd);
 
         int again = read_int("Do you want to explore more? (1=yes, 0=no): ");
         if (again == 0) break;
@@ -575,6 +784,9 @@ int main(void) {
     }
 
     db_free(&db);
+    neo_index_free(&idx);
+    name_index_free(&names);
+    kd_index_free(&kd);
     printf("That's all baby!!\n");
     return 0;
 }
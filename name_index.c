@@ -0,0 +1,550 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "name_index.h"
+
+static int edit_distance(const char *a, const char *b) {
+    int row[STR_MAX + 1];
+    size_t la = strlen(a), lb = strlen(b);
+
+    for (size_t j = 0; j <= lb; j++) row[j] = (int)j;
+
+    for (size_t i = 1; i <= la; i++) {
+        int diag = row[0];
+        row[0] = (int)i;
+        for (size_t j = 1; j <= lb; j++) {
+            int up = row[j];
+            int best = diag + (a[i-1] != b[j-1]);
+            if (up + 1 < best) best = up + 1;
+            if (row[j-1] + 1 < best) best = row[j-1] + 1;
+            row[j] = best;
+            diag = up;
+        }
+    }
+    return row[lb];
+}
+
+/* Bit-parallel edit distance (Myers/Hyyro): the query is encoded once as
+   per-character bitmasks, then each comparison costs one pass over the other string. */
+typedef struct {
+    const char *key;
+    size_t len;
+    uint64_t peq[256];
+} NameQuery;
+
+static void query_prepare(NameQuery *q, const char *key) {
+    q->key = key;
+    q->len = strlen(key);
+    memset(q->peq, 0, sizeof(q->peq));
+    if (q->len > 64) return;     // too long for one word, falls back to the DP
+    for (size_t i = 0; i < q->len; i++) q->peq[(unsigned char)key[i]] |= (uint64_t)1 << i;
+}
+
+static int query_distance(const NameQuery *q, const char *text) {
+    if (q->len == 0) return (int)strlen(text);
+    if (q->len > 64) return edit_distance(q->key, text);
+
+    uint64_t pv = ~(uint64_t)0, mv = 0;
+    uint64_t last = (uint64_t)1 << (q->len - 1);
+    int score = (int)q->len;
+
+    for (; *text; text++) {
+        uint64_t eq = q->peq[(unsigned char)*text];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & last) score++;
+        else if (mh & last) score--;
+
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+static int pool_add(NameIndex *ni, const char *str, size_t *off) {
+    size_t len = strlen(str) + 1;
+    if (ni->pool_size + len > ni->pool_cap) {
+        size_t next = (ni->pool_cap == 0) ? 4096 : ni->pool_cap;
+        while (next < ni->pool_size + len) next *= 2;
+        char *p = (char*)realloc(ni->pool, next);
+        if (!p) return 0;
+        ni->pool = p;
+        ni->pool_cap = next;
+    }
+    memcpy(ni->pool + ni->pool_size, str, len);
+    *off = ni->pool_size;
+    ni->pool_size += len;
+    return 1;
+}
+
+/* ---------- q-grams ---------- */
+static int gram_sym(char c) {
+    if (c >= 'a' && c <= 'z') return 1 + (c - 'a');
+    if (c >= '0' && c <= '9') return 27 + (c - '0');
+    return 0;
+}
+
+/* lists of the g-grams start after those of all shorter grams */
+static int gram_code(const char *s, int len) {
+    int code = 0, base = 0, span = 1;
+    for (int i = 0; i < len; i++) {
+        base += span;
+        span *= NAME_QGRAM_SYMS;
+        code = code * NAME_QGRAM_SYMS + gram_sym(s[i]);
+    }
+    return base - 1 + code;
+}
+
+/* Character counts of the name: one edit changes them by at most 2 in total.
+   Letters are kept as presence bits, digits and spaces as counts up to 3. */
+static uint64_t name_sig(const char *key) {
+    uint64_t sig = 0;
+    size_t len = 0;
+    for (; key[len]; len++) {
+        int c = gram_sym(key[len]);
+        if (c >= 1 && c <= 26) {
+            sig |= (uint64_t)1 << (c - 1);
+            continue;
+        }
+        int shift = NAME_SIG_COUNTS + 2 * ((c == 0) ? 10 : c - 27);
+        if (((sig >> shift) & 3) < 3) sig += (uint64_t)1 << shift;
+    }
+    return sig | ((uint64_t)len << NAME_SIG_LEN);
+}
+
+static int sig_len(uint64_t sig) {
+    return (int)((sig >> NAME_SIG_LEN) & 0xff);
+}
+
+static int sig_rejects(uint64_t a, uint64_t b, int radius) {
+    int la = sig_len(a), lb = sig_len(b);
+    if (la - lb > radius || lb - la > radius) return 1;
+
+    // popcount of the differing letters
+    uint64_t diff = (a ^ b) & (((uint64_t)1 << NAME_SIG_COUNTS) - 1);
+    diff = diff - ((diff >> 1) & 0x5555555555555555ULL);
+    diff = (diff & 0x3333333333333333ULL) + ((diff >> 2) & 0x3333333333333333ULL);
+    diff = (diff + (diff >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    int bag = (int)((diff * 0x0101010101010101ULL) >> 56);
+    if (bag > 2 * radius) return 1;
+
+    for (int shift = NAME_SIG_COUNTS; shift < NAME_SIG_LEN; shift += 2) {
+        int ca = (int)((a >> shift) & 3), cb = (int)((b >> shift) & 3);
+        bag += (ca > cb) ? ca - cb : cb - ca;
+    }
+    return bag > 2 * radius;
+}
+
+static int list_push(NameList *l, int id, uint64_t sig) {
+    if (l->size == l->cap) {
+        int next = (l->cap == 0) ? 8 : l->cap * 2;
+        int *ids = (int*)realloc(l->ids, (size_t)next * sizeof(int));
+        if (!ids) return 0;
+        l->ids = ids;
+        uint64_t *sigs = (uint64_t*)realloc(l->sigs, (size_t)next * sizeof(uint64_t));
+        if (!sigs) return 0;
+        l->sigs = sigs;
+        l->cap = next;
+    }
+    l->ids[l->size] = id;
+    l->sigs[l->size] = sig;
+    l->size++;
+    return 1;
+}
+
+static int grams_add_node(NameIndex *ni, int id) {
+    const char *key = ni->pool + ni->nodes[id].key;
+    size_t len = strlen(key);
+    uint64_t sig = name_sig(key);
+
+    for (int g = NAME_QGRAM_MIN; g <= NAME_QGRAM; g++) {
+        for (size_t p = 0; p + g <= len; p++) {
+            NameGram *gram = &ni->grams[gram_code(key + p, g)];
+            if ((int)p >= gram->size) {
+                NameList *at = (NameList*)realloc(gram->at, (p + 1) * sizeof(NameList));
+                if (!at) return 0;
+                memset(at + gram->size, 0, (p + 1 - gram->size) * sizeof(NameList));
+                gram->at = at;
+                gram->size = (int)p + 1;
+            }
+            if (!list_push(&gram->at[p], id, sig)) return 0;
+        }
+    }
+    return 1;
+}
+
+/* entries of the gram at offsets [pos - radius, pos + radius] */
+static long gram_window(const NameIndex *ni, int code, int pos, int radius) {
+    const NameGram *gram = &ni->grams[code];
+    long n = 0;
+    for (int off = (pos > radius) ? pos - radius : 0; off <= pos + radius && off < gram->size; off++) {
+        n += gram->at[off].size;
+    }
+    return n;
+}
+
+static int new_node(NameIndex *ni, const char *key, const char *name, int dist) {
+    if (ni->size == ni->cap) {
+        size_t next = (ni->cap == 0) ? 64 : ni->cap * 2;
+        NameNode *p = (NameNode*)realloc(ni->nodes, next * sizeof(NameNode));
+        if (!p) return -1;
+        ni->nodes = p;
+        ni->cap = next;
+    }
+
+    NameNode *n = &ni->nodes[ni->size];
+    if (!pool_add(ni, key, &n->key) || !pool_add(ni, name, &n->name)) return -1;
+    n->count = 1;
+    n->dist = dist;
+    n->first_child = -1;
+    n->next_sibling = -1;
+    return (int)ni->size++;
+}
+
+void name_index_init(NameIndex *ni) {
+    ni->nodes = NULL;
+    ni->size = 0;
+    ni->cap = 0;
+    ni->pool = NULL;
+    ni->pool_size = 0;
+    ni->pool_cap = 0;
+    ni->grams = NULL;
+}
+
+void name_index_free(NameIndex *ni) {
+    if (ni->grams) {
+        for (int g = 0; g < NAME_QGRAM_LISTS; g++) {
+            for (int p = 0; p < ni->grams[g].size; p++) {
+                free(ni->grams[g].at[p].ids);
+                free(ni->grams[g].at[p].sigs);
+            }
+            free(ni->grams[g].at);
+        }
+    }
+    free(ni->grams);
+    free(ni->nodes);
+    free(ni->pool);
+    name_index_init(ni);
+}
+
+/* renumbers the nodes in BFS order so every sibling list is contiguous in memory */
+static int relayout(NameIndex *ni) {
+    size_t n = ni->size;
+    if (n < 2) return 1;
+
+    int *order = (int*)malloc(n * sizeof(int));
+    int *newpos = (int*)malloc(n * sizeof(int));
+    NameNode *out = (NameNode*)malloc(ni->cap * sizeof(NameNode));
+    if (!order || !newpos || !out) {
+        free(order);
+        free(newpos);
+        free(out);
+        return 0;
+    }
+
+    size_t tail = 1;
+    order[0] = 0;
+    for (size_t h = 0; h < tail; h++) {
+        for (int c = ni->nodes[order[h]].first_child; c >= 0; c = ni->nodes[c].next_sibling) {
+            order[tail++] = c;
+        }
+    }
+    for (size_t i = 0; i < n; i++) newpos[order[i]] = (int)i;
+
+    for (size_t i = 0; i < n; i++) {
+        out[i] = ni->nodes[order[i]];
+        if (out[i].first_child >= 0) out[i].first_child = newpos[out[i].first_child];
+        if (out[i].next_sibling >= 0) out[i].next_sibling = newpos[out[i].next_sibling];
+    }
+
+    free(ni->nodes);
+    ni->nodes = out;
+    free(order);
+    free(newpos);
+    return 1;
+}
+
+/* returns the new node, NAME_SEEN when the name was already there, -1 on error */
+#define NAME_SEEN (-2)
+
+static int bk_insert(NameIndex *ni, const char *name) {
+    char key[STR_MAX];
+    normalize_name(name, key, sizeof(key));
+
+    if (ni->size == 0) return new_node(ni, key, name, 0);
+
+    NameQuery q;
+    query_prepare(&q, key);
+
+    int cur = 0;
+    for (;;) {
+        int d = query_distance(&q, ni->pool + ni->nodes[cur].key);
+        if (d == 0) {
+            if (ni->nodes[cur].count++ == 0) {
+                // revived after a delete: show the newest spelling
+                size_t off;
+                if (pool_add(ni, name, &off)) ni->nodes[cur].name = off;
+            }
+            return NAME_SEEN;
+        }
+
+        // siblings are sorted by distance
+        int prev = -1;
+        int child = ni->nodes[cur].first_child;
+        while (child >= 0 && ni->nodes[child].dist < d) {
+            prev = child;
+            child = ni->nodes[child].next_sibling;
+        }
+        if (child >= 0 && ni->nodes[child].dist == d) {
+            cur = child;
+            continue;
+        }
+
+        int added = new_node(ni, key, name, d);
+        if (added < 0) return -1;
+        ni->nodes[added].next_sibling = child;
+        if (prev >= 0) ni->nodes[prev].next_sibling = added;
+        else ni->nodes[cur].first_child = added;
+        return added;
+    }
+}
+
+int name_index_build(NameIndex *ni, const AsteroidDB *db) {
+    if (!ni->grams) {
+        ni->grams = (NameGram*)calloc(NAME_QGRAM_LISTS, sizeof(NameGram));
+        if (!ni->grams) return 0;
+    }
+    for (int g = 0; g < NAME_QGRAM_LISTS; g++) {
+        for (int p = 0; p < ni->grams[g].size; p++) ni->grams[g].at[p].size = 0;
+    }
+
+    ni->size = 0;
+    ni->pool_size = 0;
+    for (size_t i = 0; i < db->size; i++) {
+        if (bk_insert(ni, db->data[i].name) == -1) return 0;
+    }
+    if (!relayout(ni)) return 0;
+
+    // posting lists use the final node numbers
+    for (size_t i = 0; i < ni->size; i++) {
+        if (!grams_add_node(ni, (int)i)) return 0;
+    }
+    return 1;
+}
+
+int name_index_insert(NameIndex *ni, const char *name) {
+    int added = bk_insert(ni, name);
+    if (added == -1) return 0;
+    if (added >= 0 && ni->grams) return grams_add_node(ni, added);
+    return 1;
+}
+
+void name_index_remove(NameIndex *ni, const char *name) {
+    char key[STR_MAX];
+    normalize_name(name, key, sizeof(key));
+
+    NameQuery q;
+    query_prepare(&q, key);
+
+    // nodes are never unlinked, the count just drops to zero
+    int cur = (ni->size > 0) ? 0 : -1;
+    while (cur >= 0) {
+        int d = query_distance(&q, ni->pool + ni->nodes[cur].key);
+        if (d == 0) {
+            if (ni->nodes[cur].count > 0) ni->nodes[cur].count--;
+            return;
+        }
+        int child = ni->nodes[cur].first_child;
+        while (child >= 0 && ni->nodes[child].dist < d) child = ni->nodes[child].next_sibling;
+        cur = (child >= 0 && ni->nodes[child].dist == d) ? child : -1;
+    }
+}
+
+/* insertion into the sorted result list (drops the worst when full) */
+static void add_match(NameMatch *out, int *found, int k, int d, const char *name) {
+    int pos = -1;
+    if (*found < k) pos = (*found)++;
+    else if (d < out[k-1].dist) pos = k - 1;
+    if (pos < 0) return;
+
+    while (pos > 0 && out[pos-1].dist > d) {
+        out[pos] = out[pos-1];
+        pos--;
+    }
+    strncpy(out[pos].name, name, sizeof(out[pos].name)-1);
+    out[pos].name[sizeof(out[pos].name)-1] = '\0';
+    out[pos].dist = d;
+}
+
+/* does key hold the len chars of piece at an offset in [from, to]? */
+static int has_piece(const char *key, int key_len, const char *piece, int len, int from, int to) {
+    if (from < 0) from = 0;
+    if (to > key_len - len) to = key_len - len;
+    for (int off = from; off <= to; off++) {
+        if (memcmp(key + off, piece, (size_t)len) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Adds the live names at exactly `radius` edits to out, which already holds all the
+   closer ones (found of them), until k are there. The query is cut into radius+1
+   disjoint 1- to 3-grams: radius edits break at most radius of them, so a match still
+   holds one, moved by <= radius. The cut reading the fewest list entries is used.
+   Returns -1 when the query is too short to be cut that way. */
+static int gram_search(const NameIndex *ni, const NameQuery *q, int radius, NameMatch *out, int found, int k) {
+    int pieces = radius + 1;
+    int len = (int)q->len;
+    if (pieces > NAME_QGRAM_PIECES || len < NAME_QGRAM_MIN * pieces) return -1;
+
+    // best[i][j]: fewest entries to read for j grams starting at >= i
+    long best[STR_MAX + NAME_QGRAM][NAME_QGRAM_PIECES + 1];
+    long cost[STR_MAX][NAME_QGRAM + 1];
+    for (int i = len + NAME_QGRAM - 1; i >= 0; i--) {
+        for (int g = NAME_QGRAM_MIN; g <= NAME_QGRAM && i + g <= len; g++) {
+            cost[i][g] = gram_window(ni, gram_code(q->key + i, g), i, radius);
+        }
+        best[i][0] = 0;
+        for (int j = 1; j <= pieces; j++) {
+            best[i][j] = LONG_MAX;
+            if (i >= len) continue;
+            if (best[i+1][j] < best[i][j]) best[i][j] = best[i+1][j];
+            for (int g = NAME_QGRAM_MIN; g <= NAME_QGRAM && i + g <= len; g++) {
+                if (best[i+g][j-1] == LONG_MAX) continue;
+                long take = cost[i][g] + best[i+g][j-1];
+                if (take < best[i][j]) best[i][j] = take;
+            }
+        }
+    }
+
+    // chosen pieces: offset and length in the query
+    int at[NAME_QGRAM_PIECES], glen[NAME_QGRAM_PIECES];
+    int n = 0;
+    for (int i = 0, j = pieces; j > 0; ) {
+        int g = NAME_QGRAM_MIN;
+        for (; g <= NAME_QGRAM && i + g <= len; g++) {
+            if (best[i+g][j-1] != LONG_MAX && cost[i][g] + best[i+g][j-1] == best[i][j]) break;
+        }
+        if (g > NAME_QGRAM || i + g > len) {
+            i++;
+            continue;
+        }
+        at[n] = i;
+        glen[n++] = g;
+        i += g;
+        j--;
+    }
+
+    uint64_t qsig = name_sig(q->key);
+
+    for (int p = 0; p < n && found < k; p++) {
+        const char *piece = q->key + at[p];
+        const NameGram *gram = &ni->grams[gram_code(piece, glen[p])];
+
+        // an edit moves the piece by at most one position
+        int from = at[p] - radius, to = at[p] + radius;
+        for (int off = (from > 0) ? from : 0; off <= to && off < gram->size && found < k; off++) {
+            const NameList *l = &gram->at[off];
+            for (int x = 0; x < l->size && found < k; x++) {
+                // cheap lower bound first, read in order with the ids
+                if (sig_rejects(l->sigs[x], qsig, radius)) continue;
+
+                const NameNode *node = &ni->nodes[l->ids[x]];
+                if (node->count == 0) continue;
+
+                const char *key = ni->pool + node->key;
+                int key_len = sig_len(l->sigs[x]);
+
+                // already checked through an earlier offset or piece
+                int dup = has_piece(key, key_len, piece, glen[p], from, off - 1);
+                for (int e = 0; e < p && !dup; e++) {
+                    dup = has_piece(key, key_len, q->key + at[e], glen[e], at[e] - radius, at[e] + radius);
+                }
+                if (dup) continue;
+
+                // closer names came from the smaller radii
+                if (query_distance(q, key) == radius) add_match(out, &found, k, radius, ni->pool + node->name);
+            }
+        }
+    }
+    return found;
+}
+
+static int bk_search(const NameIndex *ni, const NameQuery *q, int max_dist, NameMatch *out, int k) {
+    int *stack = (int*)malloc(ni->size * sizeof(int));
+    if (!stack) return 0;
+
+    int found = 0;
+    int radius = max_dist;
+    size_t top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const NameNode *n = &ni->nodes[stack[--top]];
+        int d = query_distance(q, ni->pool + n->key);
+
+        if (n->count > 0 && d <= radius) {
+            add_match(out, &found, k, d, ni->pool + n->name);
+            // once the list is full only closer names are interesting
+            if (found == k && out[k-1].dist < radius) radius = out[k-1].dist;
+        }
+
+        // triangle inequality: only children with |dist - d| <= radius can match
+        for (int c = n->first_child; c >= 0; c = ni->nodes[c].next_sibling) {
+            int cd = ni->nodes[c].dist;
+            if (cd > d + radius) break;
+            if (cd >= d - radius) stack[top++] = c;
+        }
+    }
+
+    free(stack);
+    return found;
+}
+
+int name_index_nearest(const NameIndex *ni, const char *query, int max_dist, NameMatch *out, int k) {
+    if (ni->size == 0 || k <= 0 || max_dist < 0) return 0;
+
+    char key[STR_MAX];
+    normalize_name(query, key, sizeof(key));
+
+    NameQuery q;
+    query_prepare(&q, key);
+
+    // growing radius: typos usually have close neighbours, and small radii only walk
+    // a few short lists. Each pass can stop at k names since any name at that
+    // distance is as good as another.
+    int found = 0;
+    for (int r = 0; ni->grams && r <= max_dist; r++) {
+        found = gram_search(ni, &q, r, out, found, k);
+        if (found < 0) break;       // query too short to cut into r+1 pieces
+        if (found == k || r == max_dist) return found;
+    }
+
+    return bk_search(ni, &q, max_dist, out, k);
+}
+
+int name_index_pick(const NameIndex *ni, const char *query, char *out, size_t outsz) {
+    NameMatch m[NAME_FUZZY_K];
+    int n = name_index_nearest(ni, query, NAME_FUZZY_MAX_DIST, m, NAME_FUZZY_K);
+    if (n == 0) return 0;
+
+    printf("\nDid you mean:\n");
+    for (int i = 0; i < n; i++) printf(" %d) %s\n", i + 1, m[i].name);
+
+    char buf[64];
+    int choice = 0;
+    printf("Choose one (0 = none): ");
+    if (fgets(buf, sizeof(buf), stdin)) sscanf(buf, "%d", &choice);
+    if (choice < 1 || choice > n) return 0;
+
+    strncpy(out, m[choice-1].name, outsz-1);
+    out[outsz-1] = '\0';
+    return 1;
+}
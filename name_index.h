@@ -0,0 +1,77 @@
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <stdint.h>
+
+#include "asteroid_db.h"
+
+/* Typo-tolerant name lookup over normalized names (edit distance).
+   Names within d edits of the query still hold one of any d+1 non-overlapping
+   1- to 3-grams of it, at most d positions away, so only those posting lists are
+   read, and a per-entry character signature spares most of the string compares.
+   Queries too short to cut go through the BK-tree, which also dedups the names. */
+
+#define NAME_FUZZY_MAX_DIST 3
+#define NAME_FUZZY_K 5
+
+#define NAME_QGRAM_MIN 1
+#define NAME_QGRAM 3
+#define NAME_QGRAM_SYMS 37      // ' ', a-z, 0-9 (what normalize_name leaves)
+#define NAME_QGRAM_LISTS (NAME_QGRAM_SYMS * (1 + NAME_QGRAM_SYMS * (1 + NAME_QGRAM_SYMS)))
+#define NAME_QGRAM_PIECES 8     // largest d + 1 the filter handles
+
+#define NAME_SIG_COUNTS 26      // list entry: letters present (bits 0-25), digit and space counts,
+#define NAME_SIG_LEN 48         // and the name length
+
+typedef struct {
+    size_t key;           // normalized name (offset in NameIndex.pool)
+    size_t name;          // name as shown to the user (offset in NameIndex.pool)
+    int count;            // rows with this name (0 = removed)
+    int dist;             // distance to the parent node
+    int first_child;      // -1 = none
+    int next_sibling;
+} NameNode;
+
+typedef struct {
+    int *ids;             // nodes whose key has the gram at a given offset
+    uint64_t *sigs;       // per entry, see NAME_SIG_*: checked before the node is touched
+    int size;
+    int cap;
+} NameList;
+
+typedef struct {
+    NameList *at;         // by offset of the gram in the key
+    int size;
+} NameGram;
+
+typedef struct {
+    NameNode *nodes;      // kept small so a search touches little memory
+    size_t size;
+    size_t cap;
+
+    char *pool;           // the strings live here
+    size_t pool_size;
+    size_t pool_cap;
+
+    NameGram *grams;      // NAME_QGRAM_LISTS grams, allocated on first build
+} NameIndex;
+
+typedef struct {
+    char name[STR_MAX];
+    int dist;
+} NameMatch;
+
+void name_index_init(NameIndex *ni);
+void name_index_free(NameIndex *ni);
+
+int name_index_build(NameIndex *ni, const AsteroidDB *db);
+int name_index_insert(NameIndex *ni, const char *name);
+void name_index_remove(NameIndex *ni, const char *name);
+
+/* nearest k names within max_dist, closest first. Returns how many were found. */
+int name_index_nearest(const NameIndex *ni, const char *query, int max_dist, NameMatch *out, int k);
+
+/* prints "did you mean" suggestions and lets the user pick one (copied to out). */
+int name_index_pick(const NameIndex *ni, const char *query, char *out, size_t outsz);
+
+#endif
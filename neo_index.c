@@ -0,0 +1,464 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "neo_index.h"
+
+#define NEO_LINE_MAX 2048
+
+/* ---------- helpers ---------- */
+static unsigned long hash_id(long id) {
+    return (unsigned long)id * 2654435761UL;
+}
+
+static unsigned long hash_key(const char *s) {
+    unsigned long h = 2166136261UL;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+static int file_stamp(const char *path, long *size, long *mtime) {
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+    *size = (long)st.st_size;
+    *mtime = (long)st.st_mtime;
+    return 1;
+}
+
+/* ---------- hash chains ---------- */
+static void link_entry(NeoIndex *idx, int i) {
+    NeoEntry *e = &idx->entries[i];
+    size_t bid = hash_id(e->id) & (idx->buckets - 1);
+    size_t bkey = hash_key(e->key) & (idx->buckets - 1);
+    e->next_id = idx->head_id[bid];
+    idx->head_id[bid] = i;
+    e->next_key = idx->head_key[bkey];
+    idx->head_key[bkey] = i;
+}
+
+static int rehash(NeoIndex *idx, size_t nbuckets) {
+    int *hid = (int*)malloc(nbuckets * sizeof(int));
+    int *hkey = (int*)malloc(nbuckets * sizeof(int));
+    if (!hid || !hkey) {
+        free(hid);
+        free(hkey);
+        return 0;
+    }
+    for (size_t b = 0; b < nbuckets; b++) hid[b] = hkey[b] = -1;
+
+    free(idx->head_id);
+    free(idx->head_key);
+    idx->head_id = hid;
+    idx->head_key = hkey;
+    idx->buckets = nbuckets;
+
+    for (size_t i = 0; i < idx->size; i++) link_entry(idx, (int)i);
+    return 1;
+}
+
+static int push_entry(NeoIndex *idx, int part, long offset, long id, const char *key) {
+    if (idx->size == idx->cap) {
+        size_t next = (idx->cap == 0) ? 256 : idx->cap * 2;
+        NeoEntry *p = (NeoEntry*)realloc(idx->entries, next * sizeof(NeoEntry));
+        if (!p) return 0;
+        idx->entries = p;
+        idx->cap = next;
+    }
+
+    NeoEntry *e = &idx->entries[idx->size++];
+    e->id = id;
+    strncpy(e->key, key, sizeof(e->key)-1);
+    e->key[sizeof(e->key)-1] = '\0';
+    e->part = part;
+    e->offset = offset;
+    if (id > idx->max_id) idx->max_id = id;
+
+    // keep the load factor <= 1
+    if (idx->size > idx->buckets) return rehash(idx, idx->buckets ? idx->buckets * 2 : 256);
+    link_entry(idx, (int)idx->size - 1);
+    return 1;
+}
+
+/* ---------- partitions ---------- */
+static int find_part(const NeoIndex *idx, const char *csv) {
+    for (int i = 0; i < idx->parts_n; i++) {
+        if (strcmp(idx->parts[i].csv, csv) == 0) return i;
+    }
+    return -1;
+}
+
+static int add_part(NeoIndex *idx, const char *csv) {
+    int p = find_part(idx, csv);
+    if (p >= 0) return p;
+
+    if (idx->parts_n == idx->parts_cap) {
+        int next = (idx->parts_cap == 0) ? 8 : idx->parts_cap * 2;
+        NeoPartition *np = (NeoPartition*)realloc(idx->parts, (size_t)next * sizeof(NeoPartition));
+        if (!np) return -1;
+        idx->parts = np;
+        idx->parts_cap = next;
+    }
+
+    NeoPartition *part = &idx->parts[idx->parts_n];
+    strncpy(part->csv, csv, sizeof(part->csv)-1);
+    part->csv[sizeof(part->csv)-1] = '\0';
+    part->size = -1;
+    part->mtime = -1;
+    return idx->parts_n++;
+}
+
+static void drop_part_entries(NeoIndex *idx, int part) {
+    size_t w = 0;
+    for (size_t i = 0; i < idx->size; i++) {
+        if (idx->entries[i].part != part) idx->entries[w++] = idx->entries[i];
+    }
+    if (w == idx->size) return;
+    idx->size = w;
+    rehash(idx, idx->buckets);
+}
+
+static int scan_part(NeoIndex *idx, int part) {
+    FILE *fp = fopen(idx->parts[part].csv, "r");
+    if (!fp) return 0;
+
+    char line[NEO_LINE_MAX];
+    long off = ftell(fp);
+    while (fgets(line, sizeof(line), fp)) {
+        Asteroid a;
+        if (parse_csv_line(line, &a)) {
+            char key[STR_MAX];
+            normalize_name(a.name, key, sizeof(key));
+            if (!push_entry(idx, part, off, a.id, key)) {
+                fclose(fp);
+                return 0;
+            }
+        }
+        off = ftell(fp);
+    }
+    fclose(fp);
+    return 1;
+}
+
+/* ---------- public ---------- */
+void neo_index_init(NeoIndex *idx) {
+    idx->parts = NULL;
+    idx->parts_n = 0;
+    idx->parts_cap = 0;
+    idx->entries = NULL;
+    idx->size = 0;
+    idx->cap = 0;
+    idx->head_id = NULL;
+    idx->head_key = NULL;
+    idx->buckets = 0;
+    idx->max_id = 0;
+}
+
+void neo_index_free(NeoIndex *idx) {
+    free(idx->parts);
+    free(idx->entries);
+    free(idx->head_id);
+    free(idx->head_key);
+    neo_index_init(idx);
+}
+
+/* one "P" or "E" line (journal: appended after the last full save); returns 0 when it is malformed */
+static int apply_line(NeoIndex *idx, char *line, int journal) {
+    char *nl = strpbrk(line, "\r\n");
+    if (nl) *nl = '\0';
+
+    if (line[0] == 'P') {
+        long size, mtime;
+        int used = 0;
+        if (sscanf(line, "P %ld %ld %n", &size, &mtime, &used) != 2 || used == 0) return 0;
+        int p = add_part(idx, line + used);
+        if (p < 0) return 0;
+        // a journaled rescan mark wins over later stamps: the rows rescanned after it
+        // were never written, so only a new scan (or full save) can clear it
+        if (journal && idx->parts[p].size == -1 && idx->parts[p].mtime == -1) return 1;
+        idx->parts[p].size = size;
+        idx->parts[p].mtime = mtime;
+        return 1;
+    }
+    if (line[0] == 'E') {
+        int part, used = 0;
+        long off, id;
+        if (sscanf(line, "E %d %ld %ld %n", &part, &off, &id, &used) != 3) return 0;
+        if (part < 0 || part >= idx->parts_n) return 0;
+        return push_entry(idx, part, off, id, used ? line + used : "");
+    }
+    return 0;
+}
+
+int neo_index_load(NeoIndex *idx, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;     // no index yet, partitions will be scanned
+
+    // header: how many P and E lines the last full save wrote
+    char line[NEO_LINE_MAX];
+    int parts_n;
+    size_t entries_n;
+    if (!fgets(line, sizeof(line), fp) || sscanf(line, "NEOIDX 2 %d %zu", &parts_n, &entries_n) != 2) {
+        fclose(fp);
+        return 0;
+    }
+
+    // after them come the lines appended by inserts/deletes since that save
+    size_t body = (size_t)parts_n + entries_n, n = 0;
+    int bad = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strchr(line, '\n')) break;          // cut off mid-write
+        if (!apply_line(idx, line, n >= body)) {
+            // damaged saved part: distrust everything; damaged appended part: stop there
+            // (later stamps would otherwise hide the rows that were lost)
+            if (n < body) bad = 1;
+            break;
+        }
+        n++;
+    }
+    fclose(fp);
+
+    if (bad || n < body) {
+        // truncated or damaged: forget it, every partition gets rescanned
+        neo_index_free(idx);
+        return 0;
+    }
+    return 1;
+}
+
+int neo_index_save(const NeoIndex *idx, const char *path) {
+    // written next to the old file and renamed over it, so a crash never leaves half an index
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return 0;
+
+    int ok = fprintf(fp, "NEOIDX 2 %d %zu\n", idx->parts_n, idx->size) > 0;
+    for (int i = 0; ok && i < idx->parts_n; i++) {
+        ok = fprintf(fp, "P %ld %ld %s\n", idx->parts[i].size, idx->parts[i].mtime, idx->parts[i].csv) > 0;
+    }
+    for (size_t i = 0; ok && i < idx->size; i++) {
+        const NeoEntry *e = &idx->entries[i];
+        ok = fprintf(fp, "E %d %ld %ld %s\n", e->part, e->offset, e->id, e->key) > 0;
+    }
+
+    if (fflush(fp) != 0 || ferror(fp)) ok = 0;
+    if (fclose(fp) != 0) ok = 0;
+    if (!ok) {
+        remove(tmp);
+        return 0;
+    }
+
+#ifdef _WIN32
+    remove(path);      // rename() does not replace on Windows
+#endif
+    if (rename(tmp, path) != 0) {
+        remove(tmp);
+        return 0;
+    }
+    return 1;
+}
+
+int neo_index_journal_row(const NeoIndex *idx, const char *path) {
+    if (idx->size == 0) return 0;
+    const NeoEntry *e = &idx->entries[idx->size - 1];
+    const NeoPartition *part = &idx->parts[e->part];
+
+    FILE *fp = fopen(path, "a");
+    if (!fp) return 0;
+
+    // the stamp goes last: if the entry is lost, the old stamp forces a rescan
+    int ok = fprintf(fp, "E %d %ld %ld %s\n", e->part, e->offset, e->id, e->key) > 0 &&
+             fprintf(fp, "P %ld %ld %s\n", part->size, part->mtime, part->csv) > 0;
+    if (fflush(fp) != 0 || ferror(fp)) ok = 0;
+    if (fclose(fp) != 0) ok = 0;
+    return ok;
+}
+
+int neo_index_journal_dirty(const char *path, const char *csv) {
+    FILE *fp = fopen(path, "a");
+    if (!fp) return 0;
+
+    int ok = fprintf(fp, "P -1 -1 %s\n", csv) > 0;
+    if (fflush(fp) != 0 || ferror(fp)) ok = 0;
+    if (fclose(fp) != 0) ok = 0;
+    return ok;
+}
+
+long neo_index_next_id(const NeoIndex *idx, const char *name) {
+    char key[STR_MAX];
+    normalize_name(name, key, sizeof(key));
+
+    // same object already seen in some partition: keep its id
+    if (idx->buckets > 0 && key[0] != '\0') {
+        for (int i = idx->head_key[hash_key(key) & (idx->buckets - 1)]; i >= 0; i = idx->entries[i].next_key) {
+            if (strcmp(idx->entries[i].key, key) == 0) return idx->entries[i].id;
+        }
+    }
+    return idx->max_id + 1;
+}
+
+int neo_index_sync_partition(NeoIndex *idx, const char *csv) {
+    int p = add_part(idx, csv);
+    if (p < 0) return 0;
+
+    long size, mtime;
+    if (!file_stamp(csv, &size, &mtime)) {
+        // partition is gone: forget its rows
+        drop_part_entries(idx, p);
+        idx->parts[p].size = -1;
+        idx->parts[p].mtime = -1;
+        return 0;
+    }
+    if (idx->parts[p].size == size && idx->parts[p].mtime == mtime) return 1;
+
+    drop_part_entries(idx, p);
+    if (!scan_part(idx, p)) return 0;
+    idx->parts[p].size = size;
+    idx->parts[p].mtime = mtime;
+    return 1;
+}
+
+int neo_index_add_row(NeoIndex *idx, const char *csv, long offset, const Asteroid *a) {
+    int p = add_part(idx, csv);
+    if (p < 0) return 0;
+
+    char key[STR_MAX];
+    normalize_name(a->name, key, sizeof(key));
+    if (!push_entry(idx, p, offset, a->id, key)) return 0;
+
+    long size, mtime;
+    if (file_stamp(csv, &size, &mtime)) {
+        idx->parts[p].size = size;
+        idx->parts[p].mtime = mtime;
+    }
+    return 1;
+}
+
+/* ---------- history ---------- */
+static int cmp_entry_loc(const void *x, const void *y) {
+    const NeoEntry *a = *(const NeoEntry * const *)x;
+    const NeoEntry *b = *(const NeoEntry * const *)y;
+    if (a->part != b->part) return (a->part < b->part) ? -1 : 1;
+    if (a->offset != b->offset) return (a->offset < b->offset) ? -1 : 1;
+    return 0;
+}
+
+static int cmp_asteroid_date(const void *x, const void *y) {
+    return strcmp(((const Asteroid*)x)->date, ((const Asteroid*)y)->date);
+}
+
+/* Reads the rows the entries point at. A row that is not the object asked for means the
+   partition changed behind the index: it is skipped and the partition's stamp is cleared. */
+static Asteroid *read_history(NeoIndex *idx, long id, const char *key, size_t *count, int *stale) {
+    *count = 0;
+
+    // collect the matching entries from the hash chain
+    size_t n = 0, cap = 16;
+    const NeoEntry **hits = (const NeoEntry**)malloc(cap * sizeof(*hits));
+    if (!hits) return NULL;
+
+    int i = (id > 0) ? idx->head_id[hash_id(id) & (idx->buckets - 1)]
+                     : idx->head_key[hash_key(key) & (idx->buckets - 1)];
+    while (i >= 0) {
+        const NeoEntry *e = &idx->entries[i];
+        int match = (id > 0) ? (e->id == id) : (strcmp(e->key, key) == 0);
+        if (match) {
+            if (n == cap) {
+                const NeoEntry **p = (const NeoEntry**)realloc(hits, cap * 2 * sizeof(*hits));
+                if (!p) break;
+                hits = p;
+                cap *= 2;
+            }
+            hits[n++] = e;
+        }
+        i = (id > 0) ? e->next_id : e->next_key;
+    }
+
+    if (n == 0) {
+        free(hits);
+        return NULL;
+    }
+
+    Asteroid *out = (Asteroid*)malloc(n * sizeof(Asteroid));
+    if (!out) {
+        free(hits);
+        return NULL;
+    }
+
+    // one open + sequential seeks per partition
+    qsort(hits, n, sizeof(*hits), cmp_entry_loc);
+
+    FILE *fp = NULL;
+    int open_part = -1;
+    size_t got = 0;
+    char line[NEO_LINE_MAX];
+
+    for (size_t k = 0; k < n; k++) {
+        int part = hits[k]->part;
+        if (part != open_part) {
+            if (fp) fclose(fp);
+            open_part = part;
+            fp = fopen(idx->parts[part].csv, "r");
+        }
+        if (!fp) continue;
+
+        int ok = fseek(fp, hits[k]->offset, SEEK_SET) == 0 &&
+                 fgets(line, sizeof(line), fp) &&
+                 parse_csv_line(line, &out[got]);
+        if (ok) {
+            char row_key[STR_MAX];
+            normalize_name(out[got].name, row_key, sizeof(row_key));
+            ok = (id > 0) ? (out[got].id == id) : (strcmp(row_key, key) == 0);
+        }
+        if (ok) {
+            got++;
+        } else if (idx->parts[part].size != -1 || idx->parts[part].mtime != -1) {
+            idx->parts[part].size = -1;
+            idx->parts[part].mtime = -1;
+            (*stale)++;
+        }
+    }
+    if (fp) fclose(fp);
+    free(hits);
+
+    *count = got;
+    if (got == 0) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+Asteroid *neo_index_history(NeoIndex *idx, long id, const char *name, size_t *count, int *rescanned) {
+    *count = 0;
+    *rescanned = 0;
+    if (idx->buckets == 0) return NULL;
+
+    char key[STR_MAX] = "";
+    if (id <= 0) {
+        normalize_name(name, key, sizeof(key));
+        if (key[0] == '\0') return NULL;
+    }
+
+    int stale = 0;
+    Asteroid *out = read_history(idx, id, key, count, &stale);
+
+    if (stale > 0) {
+        // the cleared stamps force a rescan of those partitions, then one more lookup
+        free(out);
+        for (int p = 0; p < idx->parts_n; p++) {
+            if (idx->parts[p].size == -1 && idx->parts[p].mtime == -1) neo_index_sync_partition(idx, idx->parts[p].csv);
+        }
+        *rescanned = 1;
+        stale = 0;
+        out = read_history(idx, id, key, count, &stale);
+    }
+
+    if (out) qsort(out, *count, sizeof(Asteroid), cmp_asteroid_date);
+    return out;
+}
@@ -0,0 +1,70 @@
+#ifndef NEO_INDEX_H
+#define NEO_INDEX_H
+
+#include "asteroid_db.h"
+
+/* Global index over every partition CSV: NEO id / normalized name -> (partition, row offset).
+   It is saved in NEO_INDEX_FILE and only partitions that changed on disk are rescanned. */
+
+#define NEO_INDEX_FILE "neo_index.dat"
+#define NEO_PART_MAX 64
+
+typedef struct {
+    char csv[NEO_PART_MAX];
+    long size;            // file size when it was indexed
+    long mtime;           // file mtime when it was indexed
+} NeoPartition;
+
+typedef struct {
+    long id;
+    char key[STR_MAX];    // normalized name
+    int part;             // position in NeoIndex.parts
+    long offset;          // byte offset of the row inside the CSV
+    int next_id;          // hash chains (-1 = end)
+    int next_key;
+} NeoEntry;
+
+typedef struct {
+    NeoPartition *parts;
+    int parts_n;
+    int parts_cap;
+
+    NeoEntry *entries;
+    size_t size;
+    size_t cap;
+
+    int *head_id;         // hash buckets
+    int *head_key;
+    size_t buckets;
+
+    long max_id;          // largest id seen in any partition
+} NeoIndex;
+
+void neo_index_init(NeoIndex *idx);
+void neo_index_free(NeoIndex *idx);
+
+/* the file holds a full save (header counts its lines) followed by appended changes */
+int neo_index_load(NeoIndex *idx, const char *path);
+int neo_index_save(const NeoIndex *idx, const char *path);
+
+/* appends the last added row / a "rescan this partition" mark, without rewriting the file.
+   The mark holds until the next full save, whatever stamps are appended after it. */
+int neo_index_journal_row(const NeoIndex *idx, const char *path);
+int neo_index_journal_dirty(const char *path, const char *csv);
+
+/* id for a new row: the existing one if the name is already indexed, else global max + 1 */
+long neo_index_next_id(const NeoIndex *idx, const char *name);
+
+/* rescans the partition only if the CSV changed since it was indexed */
+int neo_index_sync_partition(NeoIndex *idx, const char *csv);
+
+/* registers one row appended to csv at the given offset */
+int neo_index_add_row(NeoIndex *idx, const char *csv, long offset, const Asteroid *a);
+
+/* reads back only the rows of this object (by id, or by name if id <= 0), sorted by date.
+   Every row read is checked against the query; if one is not, its partition is rescanned
+   and *rescanned set so the caller can save the index.
+   Returns a malloc'd array (caller frees) or NULL when nothing was found. */
+Asteroid *neo_index_history(NeoIndex *idx, long id, const char *name, size_t *count, int *rescanned);
+
+#endif